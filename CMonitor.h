@@ -0,0 +1,155 @@
+// Monitorización da conversión (CRoot.C). Vai nun ficheiro á parte para que as macros de análise,
+// que só inclúen CRoot1.h, non carguen o THttpServer. Inclúese despois de CRoot1.h.
+
+#include <TH1F.h>
+#include <TFile.h>
+#include <TSystem.h>
+#include <THttpServer.h>
+#include <ctime>
+
+// Monitorización en liña durante a conversión: cada suceso actualiza en O(1) os histogramas de
+// sucesos por ventá de tempo, intervalos entre sucesos, carga de cada canal e pulsos por canal
+// (os eixos amplíanse sós se un valor cae fóra; no de sucesos por ventá engádense bins, así cada
+// bin segue sendo unha ventá de <rateWindow> segundos en medidas longas). Cada <period> segundos escríbese unha copia a
+// <snapshotFile> (nun ficheiro temporal que logo se renomea, así nunca se le a medio escribir).
+// Se port>0 os histogramas sérvense tamén en http://localhost:<port> co THttpServer de ROOT.
+// Se idle>0 a conversión segue esperando por datos novos no .txt ata <idle> segundos sen cambios.
+
+class CMonitor {
+
+public:
+CMonitor(const char* snapshotFile,Int_t snapPeriod=60,Float_t rateWindow=10,Int_t port=0,Int_t idleTime=0);
+~CMonitor();
+
+void AddEvent(CScopeEvent* scopeEvent,CPulseEvent* pulseEvent,CShapeEvent* shapeEvent=0);
+void Wait();
+void Snapshot();
+
+Int_t GetIdle(){return idle;}
+Long64_t GetNEvents(){return nevents;}
+
+private:
+void check();
+void extendRate(Double_t x);
+
+TString snapshot;
+Int_t period;
+Int_t idle;
+THttpServer* server;
+time_t lastSnapshot;
+Long64_t nevents;
+ULong64_t tFirst;
+ULong64_t tPrev;
+TH1F* h_rate;
+TH1F* h_interval;
+TH1F* h_charge[4];
+TH1F* h_pulses;
+};
+
+
+CMonitor::CMonitor(const char* snapshotFile,Int_t snapPeriod,Float_t rateWindow,Int_t port,Int_t idleTime){
+if(C_DEBUG) cout << "Enters CMonitor::CMonitor(const char* ,Int_t ,Float_t ,Int_t ,Int_t )" << endl;
+snapshot=snapshotFile; period=snapPeriod; idle=idleTime;
+nevents=0; tFirst=0; tPrev=0;
+lastSnapshot=time(NULL);
+const char* chName[4] = {"A","B","C","D"};
+
+h_rate = new TH1F("mon_rate",Form("Events per %g s window;Time (s);events",rateWindow),100,0,100*rateWindow);
+h_interval = new TH1F("mon_interval","Time between events;Delta T (us);counts",100,0,1000000);
+for(int ch=0; ch<4; ch++)
+  h_charge[ch] = new TH1F(Form("mon_charge_%s",chName[ch]),Form("Charge %s;charge;events",chName[ch]),100,0,30000);
+h_pulses = new TH1F("mon_pulses","Events with pulses per channel;channel;events",4,0,4);
+for(int ch=0; ch<4; ch++) h_pulses->GetXaxis()->SetBinLabel(ch+1,chName[ch]);
+
+TH1F* hists[7] = {h_rate,h_interval,h_charge[0],h_charge[1],h_charge[2],h_charge[3],h_pulses};
+server = 0;
+if(port>0) server = new THttpServer(Form("http:%d",port));
+for(int i=0; i<7; i++){
+  hists[i]->SetDirectory(0);  // non se gardan no ficheiro da conversión
+  if(i>0 && i<6) hists[i]->SetCanExtend(TH1::kAllAxes);
+  if(server) server->Register("/monitor",hists[i]);
+}
+if(C_DEBUG) cout << "Exits CMonitor::CMonitor(const char* ,Int_t ,Float_t ,Int_t ,Int_t )" << endl;
+}
+
+CMonitor::~CMonitor(){
+if(C_DEBUG) cout << "Enters CMonitor::~CMonitor()" << endl;
+delete server;
+delete h_rate; delete h_interval; delete h_pulses;
+for(int ch=0; ch<4; ch++) delete h_charge[ch];
+if(C_DEBUG) cout << "Exits CMonitor::~CMonitor()" << endl;
+}
+
+void CMonitor::AddEvent(CScopeEvent* scopeEvent,CPulseEvent* pulseEvent,CShapeEvent* shapeEvent){
+ULong64_t t = scopeEvent->GetEventTime();
+if(nevents==0) tFirst=t;
+else h_interval->Fill(t-tPrev);
+Double_t x = (t-tFirst)*1.e-6;
+if(x>=h_rate->GetXaxis()->GetXmax()) extendRate(x);
+h_rate->Fill(x);
+tPrev=t;
+nevents++;
+
+Float_t charge[4];
+if(shapeEvent){
+  charge[0]=shapeEvent->GetCharge_A(); charge[1]=shapeEvent->GetCharge_B();
+  charge[2]=shapeEvent->GetCharge_C(); charge[3]=shapeEvent->GetCharge_D();
+}
+else{
+  vector<int> amp[4] = {scopeEvent->GetAmpA(),scopeEvent->GetAmpB(),scopeEvent->GetAmpC(),scopeEvent->GetAmpD()};
+  for(int ch=0; ch<4; ch++){
+    int sum=0;
+    for(int i=0; i<amp[ch].size(); i++) sum += -amp[ch][i];
+    charge[ch]=sum;
+  }
+}
+for(int ch=0; ch<4; ch++) h_charge[ch]->Fill(charge[ch]);
+
+vector<Float_t> tmin[4] = {pulseEvent->GetTimeAtMin_A(),pulseEvent->GetTimeAtMin_B(),pulseEvent->GetTimeAtMin_C(),pulseEvent->GetTimeAtMin_D()};
+for(int ch=0; ch<4; ch++) if(tmin[ch].size()>0 && tmin[ch][0]>0) h_pulses->Fill(ch);
+
+check();
+}
+
+void CMonitor::Wait(){
+// chamado mentres a conversión espera por datos novos: o servidor atende sempre
+gSystem->ProcessEvents();
+check();
+}
+
+void CMonitor::extendRate(Double_t x){
+// duplica o número de bins ata que x entre, co mesmo ancho de ventá
+Int_t n = h_rate->GetNbinsX();
+Double_t width = h_rate->GetXaxis()->GetBinWidth(1);
+Int_t nnew = n;
+while(x>=nnew*width) nnew *= 2;
+vector<Double_t> content(n);
+for(int i=1; i<=n; i++) content[i-1] = h_rate->GetBinContent(i);
+Double_t entries = h_rate->GetEntries();
+h_rate->SetBins(nnew,0,nnew*width);
+for(int i=1; i<=n; i++) h_rate->SetBinContent(i,content[i-1]);
+h_rate->SetEntries(entries);
+}
+
+void CMonitor::check(){
+if(server && nevents%100==0) gSystem->ProcessEvents();
+time_t now=time(NULL);
+if(now-lastSnapshot>=period){
+  Snapshot();
+  lastSnapshot=now;
+}
+}
+
+void CMonitor::Snapshot(){
+if(server) gSystem->ProcessEvents();
+TString tmp = snapshot+".tmp";
+TDirectory* dir = gDirectory;
+TFile* f = new TFile(tmp,"RECREATE");
+h_rate->Write(); h_interval->Write(); h_pulses->Write();
+for(int ch=0; ch<4; ch++) h_charge[ch]->Write();
+f->Close();
+delete f;
+gSystem->Rename(tmp,snapshot);
+dir->cd();
+if(C_DEBUG) cout << "Snapshot of " << nevents << " events written to " << snapshot << endl;
+}
@@ -10,6 +10,8 @@
 #include <TObject.h>
 #include <TMath.h>
 #include <iostream>
+#include <fstream>
+#include <algorithm>
 #include "TTree.h"
 #include "TROOT.h"
 #include <TStyle.h>
@@ -21,15 +23,28 @@
 #include <TGraph.h>
 #include <TMultiGraph.h>
 #include <TTimer.h>
+#include <TString.h>
+#include <TObjArray.h>
+#include <TBranch.h>
+#include <TChain.h>
+#include <TSystem.h>
 
 using namespace std;
 
 Int_t C_DEBUG=0; //A global DEBUG variable:
    //0 absolutly no output (quiet)
    //1 DEBUG mode
+Int_t C_NBASELINE=10;       //Maximum number of pre-trigger samples used for the baseline estimate
+Int_t C_TRIGGER_TIME=0;     //Time of the trigger in the time base of the scope: the baseline uses the samples before it
+Float_t C_CFD_FRACTION=0.3; //Fraction of the pulse amplitude used by the constant-fraction discriminator
 
 class CScopeEvent;
 class CPulseEvent;
+class CShapeEvent;
+class CMatchedFilter;
+class CQuantileSketch;
+class CNpyWriter;
+class CLiveTime;
 
 
 class CScopeEvent : public TObject {
@@ -61,6 +76,8 @@ return ampC;
 vector<int> GetAmpD(){
 return ampD;
 }
+// Sen copia e por canal ('A'..'D'); con SelectChannels só se le da árbore o canal pedido
+const vector<int>& GetAmp(char ch) const;
 
 Bool_t isCorrect(){
 return correct;
@@ -125,6 +142,17 @@ for (int i = 0; i < timeBase.size(); i++)
   cout << timeBase[i] << " " << ampA[i] << " " << ampB[i] << " " << ampC[i] << " " << ampD[i] << endl;
 }
 
+const vector<int>& CScopeEvent::GetAmp(char ch) const{
+static const vector<int> empty;
+switch(ch){
+  case 'A': return ampA;
+  case 'B': return ampB;
+  case 'C': return ampC;
+  case 'D': return ampD;
+}
+return empty;
+}
+
 
 class CPulseEvent : public TObject {
 
@@ -150,6 +178,10 @@ vector<Float_t> GetWidth_B(){return width_B;}
 vector<Float_t> GetWidth_C(){return width_C;}
 vector<Float_t> GetWidth_D(){return width_D;}
 
+const vector<Float_t>& GetAmpAtMin(char ch) const;
+const vector<Float_t>& GetTimeAtMin(char ch) const;
+const vector<Float_t>& GetWidth(char ch) const;
+
 // int GetPeak(){return peak;}
 
 private:
@@ -189,6 +221,39 @@ if(C_DEBUG) cout << "Enters CPulseEvent::CPulseEvent()" << endl;
 if(C_DEBUG) cout << "Exits CPulseEvent::CPulseEvent()" << endl;
 }
 
+const vector<Float_t>& CPulseEvent::GetAmpAtMin(char ch) const{
+static const vector<Float_t> empty;
+switch(ch){
+  case 'A': return ampAtMin_A;
+  case 'B': return ampAtMin_B;
+  case 'C': return ampAtMin_C;
+  case 'D': return ampAtMin_D;
+}
+return empty;
+}
+
+const vector<Float_t>& CPulseEvent::GetTimeAtMin(char ch) const{
+static const vector<Float_t> empty;
+switch(ch){
+  case 'A': return timeAtMin_A;
+  case 'B': return timeAtMin_B;
+  case 'C': return timeAtMin_C;
+  case 'D': return timeAtMin_D;
+}
+return empty;
+}
+
+const vector<Float_t>& CPulseEvent::GetWidth(char ch) const{
+static const vector<Float_t> empty;
+switch(ch){
+  case 'A': return width_A;
+  case 'B': return width_B;
+  case 'C': return width_C;
+  case 'D': return width_D;
+}
+return empty;
+}
+
 
 
 
@@ -596,3 +661,810 @@ delete widthAtMin;
 
 if(C_DEBUG) cout << "Exits CPulseEvent::CPulseEvent(CScopeEvent* , Int_t ,unsigned long int ,Int_t )" << endl;
 }
+
+
+
+// Etapa opcional da conversión: nunha soa pasada por canal calcúlase a liña base cos puntos
+// anteriores ao trigger (tempo<C_TRIGGER_TIME, como moito C_NBASELINE), o tempo dun discriminador
+// de fracción constante (CFD) e a carga integrada coa liña base restada. Os resultados gárdanse
+// como escalares por canal. Só as sumas e o mínimo se vectorizan; o CFD é escalar, pero só
+// percorre os puntos da subida do pulso.
+
+class CShapeEvent : public TObject {
+
+public:
+CShapeEvent();
+CShapeEvent(CScopeEvent* anEvent,Int_t threshold);
+~CShapeEvent();
+
+Float_t GetBaseline_A(){return baseline_A;}
+Float_t GetBaseline_B(){return baseline_B;}
+Float_t GetBaseline_C(){return baseline_C;}
+Float_t GetBaseline_D(){return baseline_D;}
+
+Float_t GetCfdTime_A(){return cfdTime_A;}
+Float_t GetCfdTime_B(){return cfdTime_B;}
+Float_t GetCfdTime_C(){return cfdTime_C;}
+Float_t GetCfdTime_D(){return cfdTime_D;}
+
+Float_t GetCharge_A(){return charge_A;}
+Float_t GetCharge_B(){return charge_B;}
+Float_t GetCharge_C(){return charge_C;}
+Float_t GetCharge_D(){return charge_D;}
+
+Float_t GetBaseline(char ch) const;
+Float_t GetCfdTime(char ch) const;
+Float_t GetCharge(char ch) const;
+
+private:
+void processChannel(Int_t threshold,const vector<int>& time,const vector<int>& amp,Float_t* baseline,Float_t* cfdTime,Float_t* charge);
+
+Float_t baseline_A;
+Float_t baseline_B;
+Float_t baseline_C;
+Float_t baseline_D;
+Float_t cfdTime_A;
+Float_t cfdTime_B;
+Float_t cfdTime_C;
+Float_t cfdTime_D;
+Float_t charge_A;
+Float_t charge_B;
+Float_t charge_C;
+Float_t charge_D;
+
+ClassDef(CShapeEvent,1);
+};
+
+
+CShapeEvent::CShapeEvent(){
+if(C_DEBUG) cout << "Enters CShapeEvent::CShapeEvent()" << endl;
+baseline_A=0; baseline_B=0; baseline_C=0; baseline_D=0;
+cfdTime_A=-1; cfdTime_B=-1; cfdTime_C=-1; cfdTime_D=-1;
+charge_A=0; charge_B=0; charge_C=0; charge_D=0;
+if(C_DEBUG) cout << "Exits CShapeEvent::CShapeEvent()" << endl;
+}
+
+CShapeEvent::CShapeEvent(CScopeEvent* anEvent, Int_t threshold){
+if(C_DEBUG) cout << "Enters CShapeEvent::CShapeEvent(CScopeEvent* ,Int_t )" << endl;
+vector<int> time=anEvent->GetTimeBase();
+processChannel(threshold,time,anEvent->GetAmpA(),&baseline_A,&cfdTime_A,&charge_A);
+processChannel(threshold,time,anEvent->GetAmpB(),&baseline_B,&cfdTime_B,&charge_B);
+processChannel(threshold,time,anEvent->GetAmpC(),&baseline_C,&cfdTime_C,&charge_C);
+processChannel(threshold,time,anEvent->GetAmpD(),&baseline_D,&cfdTime_D,&charge_D);
+if(C_DEBUG) cout << "Exits CShapeEvent::CShapeEvent(CScopeEvent* ,Int_t )" << endl;
+}
+
+CShapeEvent::~CShapeEvent(){
+if(C_DEBUG) cout << "Enters CShapeEvent::~CShapeEvent()" << endl;
+if(C_DEBUG) cout << "Exits CShapeEvent::~CShapeEvent()" << endl;
+}
+
+Float_t CShapeEvent::GetBaseline(char ch) const{
+switch(ch){
+  case 'A': return baseline_A;
+  case 'B': return baseline_B;
+  case 'C': return baseline_C;
+  case 'D': return baseline_D;
+}
+return 0;
+}
+
+Float_t CShapeEvent::GetCfdTime(char ch) const{
+switch(ch){
+  case 'A': return cfdTime_A;
+  case 'B': return cfdTime_B;
+  case 'C': return cfdTime_C;
+  case 'D': return cfdTime_D;
+}
+return -1;
+}
+
+Float_t CShapeEvent::GetCharge(char ch) const{
+switch(ch){
+  case 'A': return charge_A;
+  case 'B': return charge_B;
+  case 'C': return charge_C;
+  case 'D': return charge_D;
+}
+return 0;
+}
+
+void CShapeEvent::processChannel(Int_t threshold,const vector<int>& time,const vector<int>& amp,Float_t* baseline,Float_t* cfdTime,Float_t* charge){
+
+int n=amp.size();
+*baseline=0; *cfdTime=-1; *charge=0;
+if(n==0) return;
+
+const int* a=amp.data();
+// Puntos pre-trigger segundo a base de tempos. Se a ventá non ten ningún, úsanse os C_NBASELINE
+// primeiros puntos (avísase unha vez: a liña base pode incluír parte do pulso)
+int nBase=0;
+while(nBase<n && nBase<C_NBASELINE && time[nBase]<C_TRIGGER_TIME) nBase++;
+if(nBase==0){
+  static Bool_t warned=kFALSE;
+  if(!warned) cout << "CShapeEvent: no samples before the trigger time " << C_TRIGGER_TIME
+                   << ", the baseline uses the first " << C_NBASELINE << " samples" << endl;
+  warned=kTRUE;
+  nBase = (C_NBASELINE<n) ? C_NBASELINE : n;
+}
+
+// Bucles sen ramas sobre memoria contigua: o compilador vectorízaos (suma de enteiros e mínimo)
+long int sumBase=0;
+for(int i=0; i<nBase; i++) sumBase += a[i];
+long int sumAll=0;
+int ampMin=a[0];
+for(int i=0; i<n; i++) {
+  sumAll += a[i];
+  ampMin = (a[i]<ampMin) ? a[i] : ampMin;
+}
+
+Float_t base=(Float_t)sumBase/nBase;
+*baseline=base;
+*charge=-((Float_t)sumAll - n*base); // sinal negativo: carga positiva como en charges_dist.C
+
+if(ampMin>=threshold) return; // ningún pulso por riba do threshold: sen tempo CFD
+
+// Primeiro punto no mínimo e logo busca cara atrás do cruce do nivel CFD na subida do pulso
+int iMin=0;
+while(a[iMin]!=ampMin) iMin++;
+Float_t level = base + C_CFD_FRACTION*(ampMin-base);
+int j=iMin;
+while(j>0 && a[j]<=level) j--;
+if(a[j]<=level) return; // o pulso empeza antes da ventá: non hai cruce
+
+// Interpolación lineal entre os puntos j (por riba do nivel) e j+1 (por debaixo)
+Float_t t1=time[j], t2=time[j+1];
+*cfdTime = t1 + (level-a[j])*(t2-t1)/(a[j+1]-a[j]);
+}
+
+
+
+// Filtro adaptado (matched filter) para atopar pulsos solapados que searchPeak perde ao saltar 30 ns.
+// O modelo (template) de cada canal é a media de pulsos limpos (un só mínimo en CPulseEvent),
+// aliñados no punto do mínimo, coa liña base restada e normalizados a amplitude 1.
+// CountPulses correlaciona o canal co modelo unha soa vez (convolución directa: o modelo ten poucos
+// puntos), colle o máximo da amplitude axustada, réstao da forma de onda e repite ata que non quede
+// ningún pico por riba de minAmp con correlación normalizada maior que minCorr. Ao restar un pulso
+// só se recalcula a correlación nas posicións que o solapan: custo O(n*m + pulsos*m*m).
+// Os produtos escalares acumúlanse en 4 carrís independentes, que o compilador vectoriza sen
+// reordenar sumas (unha soa suma en float non se vectoriza sen -ffast-math).
+
+Int_t C_MAXPULSES=10; //Maximum number of pulses searched by CMatchedFilter in one channel
+
+class CMatchedFilter {
+
+public:
+CMatchedFilter(Int_t pre=5, Int_t post=15);
+~CMatchedFilter();
+
+void AddToTemplate(Int_t channel,const vector<int>& amp);
+void FinishTemplate(Int_t channel);
+Int_t CountPulses(Int_t channel,const vector<int>& amp,Float_t minAmp,Float_t minCorr,vector<Int_t>* position=0,vector<Float_t>* amplitude=0);
+
+Int_t GetNTemplate(Int_t channel){return nTemplate[channel];}
+Bool_t isReady(Int_t channel){return ready[channel];}
+vector<Float_t> GetTemplate(Int_t channel){return tpl[channel];}
+
+private:
+void correlate(const Float_t* h,const Float_t* y,Int_t m,Int_t k0,Int_t k1,Float_t* s,Float_t* e);
+
+Int_t nPre;
+Int_t nPost;
+vector<Double_t> sumTpl[4];
+vector<Float_t> tpl[4];
+Float_t norm2[4];
+Int_t nTemplate[4];
+Bool_t ready[4];
+};
+
+
+CMatchedFilter::CMatchedFilter(Int_t pre, Int_t post){
+if(C_DEBUG) cout << "Enters CMatchedFilter::CMatchedFilter(Int_t ,Int_t )" << endl;
+nPre=pre; nPost=post;
+for(int ch=0; ch<4; ch++){
+  sumTpl[ch].assign(nPre+nPost,0.);
+  norm2[ch]=0;
+  nTemplate[ch]=0;
+  ready[ch]=kFALSE;
+}
+if(C_DEBUG) cout << "Exits CMatchedFilter::CMatchedFilter(Int_t ,Int_t )" << endl;
+}
+
+CMatchedFilter::~CMatchedFilter(){
+if(C_DEBUG) cout << "Enters CMatchedFilter::~CMatchedFilter()" << endl;
+if(C_DEBUG) cout << "Exits CMatchedFilter::~CMatchedFilter()" << endl;
+}
+
+void CMatchedFilter::AddToTemplate(Int_t channel,const vector<int>& amp){
+int n=amp.size();
+if(n==0 || ready[channel]) return;
+const int* a=amp.data();
+int nBase = (C_NBASELINE<n) ? C_NBASELINE : n;
+Float_t base=0;
+for(int i=0; i<nBase; i++) base += a[i];
+base /= nBase;
+
+int iMin=0;
+for(int i=1; i<n; i++) if(a[i]<a[iMin]) iMin=i;
+Float_t height = base-a[iMin];
+if(iMin-nPre<0 || iMin+nPost>n || height<=0) return; // pulso demasiado preto do bordo da ventá
+
+for(int j=0; j<nPre+nPost; j++) sumTpl[channel][j] += (base-a[iMin-nPre+j])/height;
+nTemplate[channel]++;
+}
+
+void CMatchedFilter::FinishTemplate(Int_t channel){
+if(nTemplate[channel]==0) return;
+tpl[channel].resize(nPre+nPost);
+norm2[channel]=0;
+for(int j=0; j<nPre+nPost; j++){
+  tpl[channel][j] = sumTpl[channel][j]/nTemplate[channel];
+  norm2[channel] += tpl[channel][j]*tpl[channel][j];
+}
+ready[channel]=kTRUE;
+}
+
+Int_t CMatchedFilter::CountPulses(Int_t channel,const vector<int>& amp,Float_t minAmp,Float_t minCorr,vector<Int_t>* position,vector<Float_t>* amplitude){
+int n=amp.size();
+int m=nPre+nPost;
+if(!ready[channel] || n<m) return 0;
+
+const int* a=amp.data();
+int nBase = (C_NBASELINE<n) ? C_NBASELINE : n;
+Float_t base=0;
+for(int i=0; i<nBase; i++) base += a[i];
+base /= nBase;
+
+vector<Float_t> y(n);
+for(int i=0; i<n; i++) y[i] = base-a[i]; // pulsos positivos coa liña base restada
+const Float_t* h=tpl[channel].data();
+
+// correlación (s) e enerxía (e) da ventá en cada posición k
+vector<Float_t> s(n-m+1), e(n-m+1);
+correlate(h,y.data(),m,0,n-m,s.data(),e.data());
+
+int peak=0;
+while(peak<C_MAXPULSES){
+  int best=-1;
+  Float_t bestAmp=0;
+  for(int k=0; k<=n-m; k++){
+    Float_t fitAmp = s[k]/norm2[channel];
+    if(fitAmp>bestAmp && e[k]>0 && s[k]/sqrt(norm2[channel]*e[k])>=minCorr){
+      best=k;
+      bestAmp=fitAmp;
+    }
+  }
+  if(best<0 || bestAmp<minAmp) break;
+
+  for(int j=0; j<m; j++) y[best+j] -= bestAmp*h[j]; // restamos o pulso atopado e buscamos o seguinte
+  int k0 = (best-m+1>0) ? best-m+1 : 0;
+  int k1 = (best+m-1<n-m) ? best+m-1 : n-m;
+  correlate(h,y.data(),m,k0,k1,s.data(),e.data());
+  if(position) position->push_back(best+nPre);
+  if(amplitude) amplitude->push_back(bestAmp);
+  peak++;
+}
+return peak;
+}
+
+void CMatchedFilter::correlate(const Float_t* h,const Float_t* y,Int_t m,Int_t k0,Int_t k1,Float_t* s,Float_t* e){
+int m4 = m-m%4;
+for(int k=k0; k<=k1; k++){
+  const Float_t* yk=y+k;
+  Float_t s4[4]={0,0,0,0}, e4[4]={0,0,0,0};
+  for(int j=0; j<m4; j+=4){
+    for(int l=0; l<4; l++){
+      s4[l] += h[j+l]*yk[j+l];
+      e4[l] += yk[j+l]*yk[j+l];
+    }
+  }
+  Float_t sk=(s4[0]+s4[1])+(s4[2]+s4[3]), ek=(e4[0]+e4[1])+(e4[2]+e4[3]);
+  for(int j=m4; j<m; j++){
+    sk += h[j]*yk[j];
+    ek += yk[j]*yk[j];
+  }
+  s[k]=sk;
+  e[k]=ek;
+}
+}
+
+
+
+// Sketch de cuantís en streaming (KLL) para escoller rangos e bins dos histogramas nunha soa pasada.
+// Os valores gárdanse en compactadores por niveis: cando un nivel se enche, ordénase e só a metade
+// dos valores (pares ou impares, ao chou) sobe ao nivel seguinte con peso dobre. A memoria é
+// O(k log(n/k)) e dous sketches pódense xuntar con Merge (por exemplo un por canal ou por ficheiro).
+
+class CQuantileSketch {
+
+public:
+CQuantileSketch(Int_t kk=200);
+~CQuantileSketch();
+
+void Update(Double_t x);
+void Merge(const CQuantileSketch& other);
+Double_t GetQuantile(Double_t q);
+void GetBinning(Int_t* nbins,Double_t* lo,Double_t* hi,Double_t qlo=0.001,Double_t qhi=0.999,Int_t maxBins=200);
+
+Long64_t GetN(){return n;}
+Double_t GetMin(){return xmin;}
+Double_t GetMax(){return xmax;}
+
+private:
+Int_t capacity(Int_t level);
+void compress();
+
+Int_t k;
+Long64_t n;
+Double_t xmin;
+Double_t xmax;
+UInt_t seed;
+vector< vector<Double_t> > compactors;
+};
+
+
+CQuantileSketch::CQuantileSketch(Int_t kk){
+k=kk; n=0; xmin=0; xmax=0; seed=12345;
+compactors.resize(1);
+}
+
+CQuantileSketch::~CQuantileSketch(){
+}
+
+Int_t CQuantileSketch::capacity(Int_t level){
+// os niveis altos teñen capacidade k e os baixos decrecen en (2/3) por nivel
+Int_t depth = compactors.size()-1-level;
+Int_t c = (Int_t)ceil(k*pow(2./3.,depth));
+return (c<2) ? 2 : c;
+}
+
+void CQuantileSketch::Update(Double_t x){
+if(n==0 || x<xmin) xmin=x;
+if(n==0 || x>xmax) xmax=x;
+n++;
+compactors[0].push_back(x);
+if(compactors[0].size()>=capacity(0)) compress();
+}
+
+void CQuantileSketch::compress(){
+for(int h=0; h<compactors.size(); h++){
+  if(compactors[h].size()<capacity(h)) continue;
+  if(h+1==compactors.size()) compactors.resize(h+2);
+  vector<Double_t>& c = compactors[h];
+  sort(c.begin(),c.end());
+  Double_t leftover = 0;
+  Bool_t odd = (c.size()%2==1);
+  if(odd){ leftover=c.back(); c.pop_back(); }
+  seed = seed*1103515245+12345; // LCG: só fai falla un bit aleatorio por compactación
+  int offset = (seed>>16)&1;
+  for(int i=offset; i<c.size(); i+=2) compactors[h+1].push_back(c[i]);
+  c.clear();
+  if(odd) c.push_back(leftover);
+}
+}
+
+void CQuantileSketch::Merge(const CQuantileSketch& other){
+if(other.n==0) return;
+if(n==0 || other.xmin<xmin) xmin=other.xmin;
+if(n==0 || other.xmax>xmax) xmax=other.xmax;
+n += other.n;
+if(compactors.size()<other.compactors.size()) compactors.resize(other.compactors.size());
+for(int h=0; h<other.compactors.size(); h++)
+  compactors[h].insert(compactors[h].end(),other.compactors[h].begin(),other.compactors[h].end());
+compress();
+}
+
+Double_t CQuantileSketch::GetQuantile(Double_t q){
+if(n==0) return 0;
+if(q<=0) return xmin;
+if(q>=1) return xmax;
+vector< pair<Double_t,Double_t> > items; // (valor, peso)
+Double_t total=0;
+for(int h=0; h<compactors.size(); h++){
+  Double_t w = pow(2.,h);
+  for(int i=0; i<compactors[h].size(); i++) items.push_back(make_pair(compactors[h][i],w));
+  total += w*compactors[h].size();
+}
+sort(items.begin(),items.end());
+Double_t cum=0;
+for(int i=0; i<items.size(); i++){
+  cum += items[i].second;
+  if(cum>=q*total) return items[i].first;
+}
+return xmax;
+}
+
+void CQuantileSketch::GetBinning(Int_t* nbins,Double_t* lo,Double_t* hi,Double_t qlo,Double_t qhi,Int_t maxBins){
+// rango entre os cuantís qlo e qhi e ancho de bin de Freedman-Diaconis: 2*IQR/n^(1/3)
+*lo = GetQuantile(qlo);
+*hi = GetQuantile(qhi);
+if(*hi<=*lo) *hi = *lo+1;
+Double_t iqr = GetQuantile(0.75)-GetQuantile(0.25);
+Double_t width = 2*iqr/pow((Double_t)n,1./3.);
+Int_t nb = (width>0) ? (Int_t)ceil((*hi-*lo)/width) : 10;
+if(nb<10) nb=10;
+if(nb>maxBins) nb=maxBins;
+*nbins = nb;
+}
+
+
+
+// Escritor de ficheiros .npy (formato NumPy 1.0) para exportar columnas que os scripts de python
+// len con numpy.load(...,mmap_mode='r') sen parsear texto. Os datos escríbense en streaming e a
+// cabeceira (de tamaño fixo) reescríbese ao pechar co número final de elementos.
+// descr é o tipo de numpy: '<f4', '<i8', ... ou unha lista de campos "[('a', '<f8'), ...]".
+// Os datos escríbense coa orde de bytes da máquina (little-endian en x86).
+
+class CNpyWriter {
+
+public:
+CNpyWriter(const char* fileName,const char* type,Int_t size);
+~CNpyWriter();
+
+void Write(const void* data,Long64_t n=1);
+void Close();
+
+Bool_t isOpen(){return fp!=0;}
+Long64_t GetN(){return nItems;}
+
+private:
+void writeHeader();
+
+FILE* fp;
+TString descr;
+Int_t itemSize;
+Long64_t nItems;
+};
+
+
+CNpyWriter::CNpyWriter(const char* fileName,const char* type,Int_t size){
+descr=type; itemSize=size; nItems=0;
+fp = fopen(fileName,"wb");
+if(fp==NULL){
+  cout << "Cannot open " << fileName << endl;
+  return;
+}
+setvbuf(fp,NULL,_IOFBF,1<<20);
+writeHeader();
+}
+
+CNpyWriter::~CNpyWriter(){
+Close();
+}
+
+void CNpyWriter::writeHeader(){
+const int headerSize=256; // múltiplo de 64 como pide o formato
+TString dict = TString::Format("{'descr': %s, 'fortran_order': False, 'shape': (%lld,), }",
+                               descr.BeginsWith("[") ? descr.Data() : Form("'%s'",descr.Data()),nItems);
+while(dict.Length()<headerSize-10-1) dict += " ";
+dict += "\n";
+unsigned short len=dict.Length();
+unsigned char preamble[10]={0x93,'N','U','M','P','Y',1,0,(unsigned char)(len&0xff),(unsigned char)(len>>8)};
+fseek(fp,0,SEEK_SET);
+fwrite(preamble,1,10,fp);
+fwrite(dict.Data(),1,len,fp);
+}
+
+void CNpyWriter::Write(const void* data,Long64_t n){
+if(fp==0) return;
+fwrite(data,itemSize,n,fp);
+nItems += n;
+}
+
+void CNpyWriter::Close(){
+if(fp==0) return;
+writeHeader(); // agora xa se coñece a forma final
+fclose(fp);
+fp=0;
+}
+
+
+
+// Lectura parcial da árbore: SelectBranches(myT,"event.eventTime") deixa activa só a sub-rama
+// eventTime da rama partida (split) "event", e GetEntry non le nin descomprime o resto.
+// Cada elemento da lista (separados por espazos) pode ser unha rama enteira ("pulse") ou
+// rama.sub-rama ("pulse.ampAtMin_D"). Se a rama non está partida lese enteira.
+// "*" volve activar todas as ramas.
+// Faise con TTree::SetBranchStatus, que un TChain aplica tamén aos ficheiros que carga despois.
+// As sub-ramas non levan o nome da rama nai, así que unha sub-rama co mesmo nome noutra rama
+// (eventTime en "event" e "pulse", fUniqueID...) tamén se le.
+
+void SelectBranches(TTree* tree,const char* list){
+tree->SetBranchStatus("*",0);
+TObjArray* tokens = TString(list).Tokenize(" ");
+for(int t=0; t<tokens->GetEntries(); t++){
+  TString tok = tokens->At(t)->GetName();
+  Ssiz_t dot = tok.First('.');
+  TString name = (dot>0) ? TString(tok(0,dot)) : tok;
+  if(tok=="*"){
+    tree->SetBranchStatus("*",1);
+    continue;
+  }
+  TBranch* branch = tree->GetBranch(name);
+  if(!branch) continue;
+  TObjArray* subs = branch->GetListOfBranches();
+  if(dot>0 && subs->GetEntries()>0) tree->SetBranchStatus(TString(tok(dot+1,tok.Length())),1);
+  else{ // rama enteira, ou rama sen partir
+    tree->SetBranchStatus(name,1);
+    for(int i=0; i<subs->GetEntries(); i++) tree->SetBranchStatus(subs->At(i)->GetName(),1);
+  }
+}
+delete tokens;
+}
+
+
+// Lectura por canais: SelectChannels(myT,"D") deixa activas só as sub-ramas do canal D (ampD,
+// ampAtMin_D, timeAtMin_D, width_D, charge_D...) e as comúns a todos os canais (eventTime,
+// timeBase...). A base de tempos ten tantas mostras coma un canal, así un só canal le arredor de
+// 2/5 das formas de onda; con timeBase=kFALSE non se le a base de tempos e queda nun cuarto (para
+// análises que só usan as amplitudes). Avisa se algunha rama non está partida (árbores antigas
+// ou escritas con splitlevel 0): esa lese enteira.
+void SelectChannels(TTree* tree,const char* channels,Bool_t timeBase=kTRUE){
+TString list;
+TObjArray* branches = tree->GetListOfBranches();
+for(int b=0; b<branches->GetEntries(); b++){
+  TBranch* branch = (TBranch*)branches->At(b);
+  TString name = branch->GetName();
+  TObjArray* subs = branch->GetListOfBranches();
+  if(subs->GetEntries()==0){
+    cout << "Branch " << name << " is not split: all its channels are read" << endl;
+    list += name+" ";
+    continue;
+  }
+  for(int i=0; i<subs->GetEntries(); i++){
+    TString sub = subs->At(i)->GetName();
+    char last = sub[sub.Length()-1];
+    Bool_t perChannel = (last>='A' && last<='D') && (sub.EndsWith(Form("_%c",last)) || sub==Form("amp%c",last));
+    if(!timeBase && sub=="timeBase") continue;
+    if(!perChannel || strchr(channels,last)) list += name+"."+sub+" ";
+  }
+}
+SelectBranches(tree,list);
+}
+
+
+
+// Tempo vivo dunha medida a partir dos tempos de trigger ordenados, nunha soa pasada.
+// Un intervalo maior que gapFactor veces o intervalo medio do segmento actual (ou que gap us, se
+// gap>0) é unha pausa da adquisición entre bloques de ps3000aCon: pecha o segmento e abre outro.
+// O intervalo mínimo dentro dos segmentos tómase como tempo morto do rearme do osciloscopio
+// (non paralizable): cada suceso deixa o detector cego durante ese tempo. Os intervalos nulos
+// (tempo de trigger repetido) non son un rearme e non contan; deadTime=0 é "sen medir".
+// O obxecto gárdase co nome "liveTime" no ficheiro .root xunto á árbore myT.
+
+Float_t C_GAP_FACTOR=20;  //Interval (in mean intervals of the segment) that is a gap of the acquisition
+Int_t C_GAP_MINEVENTS=10; //Events of a segment before gaps can be found
+
+class CLiveTime : public TObject {
+
+public:
+CLiveTime();
+CLiveTime(ULong64_t gapAbs);
+~CLiveTime();
+
+void AddTime(ULong64_t t);
+void Finish();
+
+Long64_t GetNEvents(){return nev;}
+Int_t GetNSegments(){return segStart.size();}
+ULong64_t GetSegmentStart(Int_t i){return segStart[i];}
+ULong64_t GetSegmentEnd(Int_t i){return segEnd[i];}
+Long64_t GetSegmentEvents(Int_t i){return segEvents[i];}
+ULong64_t GetDeadTime(){return deadTime;}
+Double_t GetRealTime();
+Double_t GetLiveTime();
+Double_t GetRate();
+Double_t GetRateError();
+Bool_t isGapStart(ULong64_t t);
+
+private:
+ULong64_t gap;
+Long64_t nev;
+ULong64_t deadTime;
+ULong64_t tLast;
+ULong64_t curStart;
+Long64_t curEvents;
+vector<ULong64_t> segStart;
+vector<ULong64_t> segEnd;
+vector<Long64_t> segEvents;
+
+ClassDef(CLiveTime,1);
+};
+
+
+CLiveTime::CLiveTime(){
+if(C_DEBUG) cout << "Enters CLiveTime::CLiveTime()" << endl;
+gap=0; nev=0; deadTime=0; tLast=0; curStart=0; curEvents=0;
+if(C_DEBUG) cout << "Exits CLiveTime::CLiveTime()" << endl;
+}
+
+CLiveTime::CLiveTime(ULong64_t gapAbs){
+if(C_DEBUG) cout << "Enters CLiveTime::CLiveTime(ULong64_t)" << endl;
+gap=gapAbs; nev=0; deadTime=0; tLast=0; curStart=0; curEvents=0;
+if(C_DEBUG) cout << "Exits CLiveTime::CLiveTime(ULong64_t)" << endl;
+}
+
+CLiveTime::~CLiveTime(){
+if(C_DEBUG) cout << "Enters CLiveTime::~CLiveTime()" << endl;
+if(C_DEBUG) cout << "Exits CLiveTime::~CLiveTime()" << endl;
+}
+
+void CLiveTime::AddTime(ULong64_t t){
+if(curEvents>0){
+  ULong64_t dt = t-tLast;
+  Bool_t isGap;
+  if(t<tLast) isGap = kTRUE;  // o tempo volve atrás: outra medida (ficheiros dun TChain)
+  else if(gap>0) isGap = (dt>gap);
+  else isGap = (curEvents>=C_GAP_MINEVENTS && dt>C_GAP_FACTOR*(Double_t)(tLast-curStart)/(curEvents-1));
+  if(isGap){ // pecha o segmento actual
+    segStart.push_back(curStart);
+    segEnd.push_back(tLast);
+    segEvents.push_back(curEvents);
+    curEvents=0;
+  }
+  else if(dt>0 && (deadTime==0 || dt<deadTime)) deadTime=dt;
+}
+if(curEvents==0) curStart=t;
+tLast=t;
+curEvents++;
+nev++;
+}
+
+void CLiveTime::Finish(){
+if(curEvents==0) return;
+segStart.push_back(curStart);
+segEnd.push_back(tLast);
+segEvents.push_back(curEvents);
+curEvents=0;
+// segmentos ordenados no tempo aínda que as medidas non viñesen en orde (para isGapStart)
+vector<Int_t> order(segStart.size());
+for(int i=0; i<order.size(); i++) order[i]=i;
+sort(order.begin(),order.end(),[this](Int_t a,Int_t b){return segStart[a]<segStart[b];});
+vector<ULong64_t> start(order.size()), end(order.size());
+vector<Long64_t> events(order.size());
+for(int i=0; i<order.size(); i++){
+  start[i]=segStart[order[i]]; end[i]=segEnd[order[i]]; events[i]=segEvents[order[i]];
+}
+segStart.swap(start); segEnd.swap(end); segEvents.swap(events);
+}
+
+Double_t CLiveTime::GetRealTime(){
+Double_t real=0;
+for(int i=0; i<segStart.size(); i++) real += segEnd[i]-segStart[i];
+return real;
+}
+
+Double_t CLiveTime::GetLiveTime(){
+// a cada intervalo dentro dos segmentos réstaselle o tempo morto
+return GetRealTime() - (Double_t)(nev-segStart.size())*deadTime;
+}
+
+Double_t CLiveTime::GetRate(){
+Double_t live = GetLiveTime();
+return (live>0) ? (Double_t)(nev-segStart.size())/live*1000000. : 0;
+}
+
+Double_t CLiveTime::GetRateError(){
+Double_t live = GetLiveTime();
+return (live>0) ? TMath::Sqrt((Double_t)(nev-segStart.size()))/live*1000000. : 0;
+}
+
+Bool_t CLiveTime::isGapStart(ULong64_t t){
+// t é o primeiro suceso dun segmento (salvo o primeiro): o intervalo anterior inclúe unha pausa
+return segStart.size()>1 && t!=segStart[0] && binary_search(segStart.begin(),segStart.end(),t);
+}
+
+
+// Tempo vivo dunha medida: o gardado no ficheiro ou, en ficheiros antigos e en TChain de varias
+// medidas, calculado nunha pasada que só le os tempos de trigger. Nun TChain lese cunha cadea
+// propia cos mesmos ficheiros, e a do chamador non cambia; nunha árbore recupérase o enderezo
+// da rama "event" e ao rematar todas as ramas quedan activas.
+CLiveTime* GetLiveTime(TFile* file,TTree* tree){
+CLiveTime* live=0;
+Bool_t isChain = tree->InheritsFrom("TChain");
+if(file && !isChain) file->GetObject("liveTime",live);
+if(live) return live;
+live = new CLiveTime();
+CScopeEvent* scope = new CScopeEvent();
+TTree* reader = tree;
+void* oldAddress = 0;
+if(isChain){
+  TChain* chain = new TChain(tree->GetName());
+  chain->Add((TChain*)tree);
+  reader = chain;
+}
+else oldAddress = tree->GetBranch("event")->GetAddress();
+reader->SetBranchAddress("event",&scope);
+SelectBranches(reader,"event.eventTime");
+Long64_t n = reader->GetEntries();
+for(Long64_t i=0; i<n; i++){
+  reader->GetEntry(i);
+  live->AddTime(scope->GetEventTime());
+}
+live->Finish();
+if(isChain) delete reader;
+else{
+  SelectBranches(tree,"*");
+  if(oldAddress) tree->SetBranchAddress("event",oldAddress);
+  else tree->ResetBranchAddress(tree->GetBranch("event"));
+}
+delete scope;
+return live;
+}
+
+
+// Primeiro tempo de trigger dun ficheiro .root (do obxecto "liveTime" se o ten), para ordenar
+// as medidas dun manifesto. Devolve 0 se o ficheiro non se pode ler.
+ULong64_t GetFirstEventTime(const char* fileName){
+ULong64_t t0=0;
+TFile* f = TFile::Open(fileName);
+if(!f || f->IsZombie()){
+  delete f;
+  return 0;
+}
+CLiveTime* live=0;
+f->GetObject("liveTime",live);
+if(live && live->GetNSegments()>0) t0 = live->GetSegmentStart(0);
+else{
+  TTree* t=0;
+  f->GetObject("myT",t);
+  if(t && t->GetEntries()>0){
+    CScopeEvent* scope = new CScopeEvent();
+    t->SetBranchAddress("event",&scope);
+    SelectBranches(t,"event.eventTime");
+    t->GetEntry(0);
+    t0 = scope->GetEventTime();
+    t->ResetBranchAddresses();
+    delete scope;
+  }
+}
+delete live;
+f->Close();
+delete f;
+return t0;
+}
+
+
+
+// Versión do conversor (CRoot.C e as clases deste ficheiro). Hai que aumentala cando cambie o
+// contido da árbore, para que convert_all.C volva converter as medidas xa convertidas.
+const Int_t C_CONVERTER_VERSION=1;
+
+
+// Árbore myT dun ficheiro .root ou, se fileName non remata en .root, TChain coas medidas dun
+// manifesto de convert_all.C: a primeira columna de cada liña é o ficheiro .root (relativo ao
+// directorio do manifesto) e as liñas que comezan por # son comentarios. As medidas engádense
+// en orde de tempo e a cadea devólvese co número de entradas xa calculado, así GetEntriesFast()
+// vale igual ca nunha árbore.
+TTree* openTree(const char* fileName){
+if(C_DEBUG) cout << "Enters openTree(const char*)" << endl;
+TString name(fileName);
+if(!name.EndsWith(".root")){
+  TChain* chain = new TChain("myT");
+  TString dir = gSystem->DirName(fileName);
+  ifstream in(fileName);
+  string line;
+  vector< pair<ULong64_t,TString> > runs;
+  while(getline(in,line)){
+    TString l(line.c_str());
+    l = l.Strip(TString::kBoth);
+    if(l.Length()==0 || l.BeginsWith("#")) continue;
+    TObjArray* tok = l.Tokenize(" \t");
+    TString path = tok->At(0)->GetName();
+    if(!gSystem->IsAbsoluteFileName(path)) path = dir+"/"+path;
+    runs.push_back(make_pair(GetFirstEventTime(path),path));
+    delete tok;
+  }
+  stable_sort(runs.begin(),runs.end(),[](const pair<ULong64_t,TString>& a,const pair<ULong64_t,TString>& b){return a.first<b.first;});
+  for(int i=0; i<runs.size(); i++) chain->Add(runs[i].second);
+  chain->GetEntries();
+  if(C_DEBUG) cout << "Exits openTree(const char*)" << endl;
+  return chain;
+}
+TFile* file;
+if(!(file = gROOT->GetFile())) file = new TFile(fileName);
+TTree* tree = 0;
+file->GetObject("myT",tree);
+if(C_DEBUG) cout << "Exits openTree(const char*)" << endl;
+return tree;
+}
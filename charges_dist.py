@@ -5,38 +5,55 @@ Created on Thu Nov 25 12:52:16 2021
 @author: daniel
 
 PROGRAM TO OBTAIN THE DISTRIBUTION OF THE CHARGES AND ISOLATE THE MAXIMA
+
+The charges are read from the columns exported by export_columns.C (directory
+<run>_columns, memory-mapped .npy files). If that directory does not exist the
+original .txt file is read with picoReader, and the samples with time > tmax
+are dropped as in the conversion to .root (CRoot.C), so both give the same charges.
 """
 
+import os
+import numpy as np
 import matplotlib.pyplot as plt
-from picocodes_modules.picoReader import ps3000Reader
 from picocodes_modules.auto_plots import histo_stats
 
 ### CONFIG
 fname = 'DATA/blocks_11/block_1000_50_7_770V.txt'
+coldir = 'DATA/blocks_11/block_1000_50_7_770V_columns'
 channel = 'D'
 max_th = 40000
 min_th = 2000
-
-
-dataobj = ps3000Reader(fname)
-
-DATA = dataobj.read_txt2()
-
-charges = []
-
-#print(DATA)
-for iev,event in DATA.items():
-    #print(event)
-    charge = -sum(event[channel])
-    charges.append(charge)
-    if charge > max_th:
-        print('max',iev,charge)
-    if charge < min_th:
-        print('min',iev,charge)
-
-print('Nev=',iev)
+tmax = 150   # samples with larger time are not in the tree (cut of CRoot.C)
+
+
+if os.path.isdir(coldir):
+    charges = np.load(os.path.join(coldir,'charge_%s.npy' %channel), mmap_mode='r')
+    print('Charges from',coldir,'(tree, samples with time <= %d)' %tmax)
+else:
+    from picocodes_modules.picoReader import ps3000Reader
+    dataobj = ps3000Reader(fname)
+    DATA = dataobj.read_txt2()
+    charges = []
+    for iev,event in DATA.items():
+        amp = np.asarray(event[channel])
+        if 'time' in event:
+            amp = amp[np.asarray(event['time']) <= tmax]
+        charges.append(-amp.sum())
+    charges = np.array(charges)
+    if len(DATA) > 0 and 'time' in next(iter(DATA.values())):
+        print('Charges from',fname,'(samples with time <= %d)' %tmax)
+    else:
+        print('Charges from',fname,'(no time column: all samples, not the cut time <= %d of the tree)' %tmax)
+
+#print(charges)
+for iev in np.nonzero(charges > max_th)[0]:
+    print('max',iev,charges[iev])
+for iev in np.nonzero(charges < min_th)[0]:
+    print('min',iev,charges[iev])
+
+print('Nev=',len(charges))
 
 plt.close('all')
 fig, ax = plt.subplots(1)
 histogram = histo_stats((charges,))
-tN, tbines, tpatches = histogram.plot_histo(ax,bins=(20,))
\ No newline at end of file
+tN, tbines, tpatches = histogram.plot_histo(ax,bins=(20,))
@@ -6,6 +6,7 @@ Created on Nov 2021
 FIT OF EVENT RATE VS. TRIGGER THRESHOLD
 """
 
+import os
 import numpy as np
 import matplotlib.pyplot as plt
 import scipy.optimize as sco
@@ -41,6 +42,20 @@ T  = np.array([237586098,6077235458,7303274908,55671388106,40782411792,519164400
 R  = np.array([4.27214,1.69666,0.186902,0.0141365,0.00534544,0.00335154])
 #"""
 
+# Data from the table made by campaign.C (if it exists), instead of the arrays above:
+campaign = 'OUTPUTS/campaign_table.txt'
+campaign_V = 770   # feed voltage of the runs to fit
+if os.path.isfile(campaign):
+    table = np.atleast_1d(np.genfromtxt(campaign, names=True, dtype=None, encoding=None))
+    table = table[table['V']==campaign_V]
+    if len(table) < 2:
+        print('Error: %d runs with V=%g in %s, at least 2 are needed for the fit' %(len(table),campaign_V,campaign))
+        raise SystemExit(1)
+    V    = table['th']
+    Nev  = table['Nev']
+    T    = table['T']
+    R    = table['R']
+
 
 sR   = np.sqrt(Nev)/(T*1e-6)
 print('sR=',sR)
@@ -6,6 +6,7 @@ Created on Nov 2021
 FIT OF EVENT RATE VS. SCINTILLATOR FEED VOLTAGE
 """
 
+import os
 import numpy as np
 import matplotlib.pyplot as plt
 import scipy.optimize as sco
@@ -25,6 +26,20 @@ T    = np.array([252105951892, 334381781888, 169956793137, 82846479017, 17979735
 R    = np.array([  0.00777054,    0.0116364,    0.0220703,   0.0442505,   0.924374])
 #"""
 
+# Data from the table made by campaign.C (if it exists), instead of the arrays above:
+campaign = 'OUTPUTS/campaign_table.txt'
+campaign_th = 1000   # trigger threshold of the runs to fit
+if os.path.isfile(campaign):
+    table = np.atleast_1d(np.genfromtxt(campaign, names=True, dtype=None, encoding=None))
+    table = table[table['th']==campaign_th]
+    if len(table) < 2:
+        print('Error: %d runs with th=%g in %s, at least 2 are needed for the fit' %(len(table),campaign_th,campaign))
+        raise SystemExit(1)
+    V    = table['V']
+    Nev  = table['Nev']
+    T    = table['T']
+    R    = table['R']
+
 sR   = np.sqrt(Nev)/(T*1e-6)
 print('sR=',sR)
 slogR = sR/R